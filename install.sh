@@ -12,7 +12,7 @@ curl -O https://raw.githubusercontent.com/zanderlewis/mdpu.c/main/mdpu.c
 # compile the mdpu.c file with the user's chosen compiler
 $COMPILER mdpu.c -o mdpu
 
-echo "mdpu has been installed successfully. You can run it with ./mdpu <registers> <memory> <filename>"
+echo "mdpu has been installed successfully. You can run it with ./mdpu <registers> <memory> <filename> [tier_threshold]"
 
 # remove the mdpu.c file
 rm mdpu.c
@@ -66,6 +66,50 @@ typedef struct {
     int immediate; // Immediate value
 } Instruction;
 
+// Define the tiers a loop region can execute in
+typedef enum {
+    TIER_INTERPRETER,
+    TIER_PREDECODED
+} Tier;
+
+// Define the structure of a pre-decoded instruction
+// Operands are resolved to pointers and bounds checked once, when the region is promoted
+typedef struct {
+    Opcode opcode;
+    int *src1;     // First source operand
+    int *src2;     // Second source operand
+    int *dst;      // Destination operand
+    int reg1;      // First register index (kept for stack operations)
+    int reg2;      // Second register index (kept for error messages)
+    int addr;      // Jump address
+    int immediate; // Immediate value
+    int back_edge;  // 1 if a taken jump lands at or before this instruction
+    int back_edges; // Back-edges taken since the region was entered
+} DecodedInstruction;
+
+// Define the structure of a loop region, bounded by a back-edge
+typedef struct {
+    int start;                // Back-edge target (loop header)
+    int end;                  // Back-edge source (loop latch)
+    int back_edges;           // Back-edge executions counted across both tiers
+    int entries;              // Transfers from the interpreter into the region
+    int instruction_count;    // Instructions executed in the pre-decoded tier
+    Tier tier;
+    const char *reason;       // Why the region was not promoted, NULL while it is a candidate
+    int owner;                // Region entered through the shared loop header instead, -1 if none
+    DecodedInstruction *code;
+} Region;
+
+// Define the structure of the tiering manager
+typedef struct {
+    Region *regions;
+    int num_regions;
+    int capacity;
+    int threshold;            // Back-edges before a region is promoted, 0 disables tiering
+    int *region_at_latch;     // Region index for each back-edge source, -1 if none
+    int *region_at_entry;     // Promoted region index for each loop header, -1 if none
+} TieringManager;
+
 // Function to initialize the processing unit
 void initialize(ProcessingUnit *pu, int num_registers, int memory_size) {
     pu->num_registers = num_registers;
@@ -347,11 +391,416 @@ void dec(ProcessingUnit *pu, int reg) {
     pu->registers[reg]--;
 }
 
+// ++++++++++++++++++++++++++++++ Tiered execution ++++++++++++++++++++++++++++++ //
+// Function to initialize the tiering manager
+void initialize_tiering(TieringManager *tm, int program_size, int threshold) {
+    tm->num_regions = 0;
+    tm->capacity = 4;
+    tm->threshold = threshold;
+
+    tm->regions = (Region *)malloc(tm->capacity * sizeof(Region));
+    tm->region_at_latch = (int *)malloc(program_size * sizeof(int));
+    tm->region_at_entry = (int *)malloc(program_size * sizeof(int));
+    if (tm->regions == NULL || (program_size > 0 && (tm->region_at_latch == NULL || tm->region_at_entry == NULL))) {
+        printf("Memory allocation failed for tiering manager\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < program_size; i++) {
+        tm->region_at_latch[i] = -1;
+        tm->region_at_entry[i] = -1;
+    }
+}
+
+// Function to free the memory allocated for the tiering manager
+void free_tiering_manager(TieringManager *tm) {
+    for (int i = 0; i < tm->num_regions; i++) {
+        if (tm->regions[i].code != NULL) {
+            free(tm->regions[i].code);
+        }
+    }
+    free(tm->regions);
+    free(tm->region_at_latch);
+    free(tm->region_at_entry);
+}
+
+// Helper function to resolve a register operand, NULL if out of bounds
+int *resolve_register(ProcessingUnit *pu, int reg) {
+    if (reg < 0 || reg >= pu->num_registers) {
+        return NULL;
+    }
+    return &pu->registers[reg];
+}
+
+// Helper function to resolve a memory operand, NULL if out of bounds
+int *resolve_memory(ProcessingUnit *pu, int addr) {
+    if (addr < 0 || addr >= pu->memory_size) {
+        return NULL;
+    }
+    return &pu->memory[addr];
+}
+
+// Function to pre-decode a single instruction, returns 0 if an operand is out of bounds
+int decode_instruction(ProcessingUnit *pu, Instruction instr, int source, DecodedInstruction *d) {
+    d->opcode = instr.opcode;
+    d->src1 = NULL;
+    d->src2 = NULL;
+    d->dst = NULL;
+    d->reg1 = instr.reg1;
+    d->reg2 = instr.reg2;
+    d->addr = instr.addr;
+    d->immediate = instr.immediate;
+    d->back_edge = 0;
+    d->back_edges = 0;
+
+    switch (instr.opcode) {
+        case ADD:
+        case SUB:
+        case MUL:
+        case DIV:
+        case MOD:
+        case AND:
+        case OR:
+        case XOR:
+        case SHL:
+        case SHR:
+            d->src1 = resolve_register(pu, instr.reg1);
+            d->src2 = resolve_register(pu, instr.reg2);
+            d->dst = resolve_register(pu, instr.reg3);
+            return d->src1 != NULL && d->src2 != NULL && d->dst != NULL;
+        case STORE:
+            d->src1 = resolve_register(pu, instr.reg1);
+            d->dst = resolve_memory(pu, instr.addr);
+            return d->src1 != NULL && d->dst != NULL;
+        case LOAD:
+            d->src1 = resolve_memory(pu, instr.addr);
+            d->dst = resolve_register(pu, instr.reg1);
+            return d->src1 != NULL && d->dst != NULL;
+        case LOAD_IMMEDIATE:
+        case INC:
+        case DEC:
+            d->dst = resolve_register(pu, instr.reg1);
+            return d->dst != NULL;
+        case PUSH:
+        case POP:
+            return resolve_register(pu, instr.reg1) != NULL;
+        case MOV:
+            d->src1 = resolve_register(pu, instr.reg2);
+            d->dst = resolve_register(pu, instr.reg1);
+            return d->src1 != NULL && d->dst != NULL;
+        case NOT:
+        case NEG:
+        case ABS:
+            d->src1 = resolve_register(pu, instr.reg1);
+            d->dst = resolve_register(pu, instr.reg2);
+            return d->src1 != NULL && d->dst != NULL;
+        case CMP:
+        case TEST:
+            d->src1 = resolve_register(pu, instr.reg1);
+            d->src2 = resolve_register(pu, instr.reg2);
+            d->dst = resolve_register(pu, 0);
+            return d->src1 != NULL && d->src2 != NULL && d->dst != NULL;
+        case JZ:
+        case JNZ:
+        case BZ:
+        case BNZ:
+            d->back_edge = instr.addr >= 0 && instr.addr <= source;
+            d->src1 = resolve_register(pu, instr.reg1);
+            return d->src1 != NULL;
+        case JE:
+        case JNE:
+            // JE and JNE fall through to the increment, so they land one past their address
+            d->back_edge = instr.addr + 1 >= 0 && instr.addr + 1 <= source;
+            d->src1 = resolve_register(pu, instr.reg1);
+            d->src2 = resolve_register(pu, instr.reg2);
+            return d->src1 != NULL && d->src2 != NULL;
+        case JMP:
+        case B:
+            d->back_edge = instr.addr >= 0 && instr.addr <= source;
+            return 1;
+        case HALT:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Function to promote a region to the pre-decoded tier
+// Regions with an operand the interpreter would reject stay interpreted, so errors are reported the same way
+void promote_region(TieringManager *tm, ProcessingUnit *pu, Instruction *program, int index) {
+    Region *region = &tm->regions[index];
+    int length = region->end - region->start + 1;
+
+    // Loops sharing a header are entered through the longest one, which runs the shorter ones inside it
+    int owner = tm->region_at_entry[region->start];
+    if (owner != -1 && tm->regions[owner].end >= region->end) {
+        region->owner = owner;
+        return;
+    }
+
+    region->code = (DecodedInstruction *)malloc(length * sizeof(DecodedInstruction));
+    if (region->code == NULL) {
+        printf("Memory allocation failed for region code\n");
+        exit(1);
+    }
+
+    for (int i = 0; i < length; i++) {
+        int source = region->start + i;
+        if (!decode_instruction(pu, program[source], source, &region->code[i])) {
+            free(region->code);
+            region->code = NULL;
+            region->reason = "operand out of bounds";
+            return;
+        }
+    }
+
+    region->tier = TIER_PREDECODED;
+    tm->region_at_entry[region->start] = index;
+}
+
+// Function to add back-edge executions to the loop latched at source, promoting it once it is hot
+void record_back_edges(TieringManager *tm, ProcessingUnit *pu, Instruction *program, int source, int taken) {
+    int index = tm->region_at_latch[source];
+    if (index == -1) {
+        Instruction instr = program[source];
+        int target = (instr.opcode == JE || instr.opcode == JNE) ? instr.addr + 1 : instr.addr;
+
+        if (tm->num_regions >= tm->capacity) {
+            tm->capacity *= 2;
+            tm->regions = (Region *)realloc(tm->regions, tm->capacity * sizeof(Region));
+            if (tm->regions == NULL) {
+                printf("Memory allocation failed for regions\n");
+                exit(1);
+            }
+        }
+
+        index = tm->num_regions++;
+        tm->region_at_latch[source] = index;
+        tm->regions[index] = (Region){target, source, 0, 0, 0, TIER_INTERPRETER, NULL, -1, NULL};
+    }
+
+    Region *region = &tm->regions[index];
+    region->back_edges += taken;
+
+    if (region->back_edges >= tm->threshold &&
+        region->tier == TIER_INTERPRETER && region->reason == NULL && region->owner == -1) {
+        promote_region(tm, pu, program, index);
+    }
+}
+
+// Function to profile a jump or branch the interpreter took at or before its own address
+// Only called with tiering enabled, returns 1 if the landing address may be a promoted loop header
+int profile_branch(TieringManager *tm, ProcessingUnit *pu, Instruction *program, int source, int instruction_pointer) {
+    Instruction instr = program[source];
+    // JE and JNE fall through to the increment, so they land one past their address
+    int target = (instr.opcode == JE || instr.opcode == JNE) ? instr.addr + 1 : instr.addr;
+
+    if (instruction_pointer != instr.addr || target < 0 || target > source) {
+        return 0;
+    }
+
+    record_back_edges(tm, pu, program, source, 1);
+    return 1;
+}
+
+// Function to execute a promoted region until the instruction pointer leaves it
+// Returns 1 if the program halted inside the region
+int execute_region(TieringManager *tm, int index, ProcessingUnit *pu, Instruction *program,
+                   int *instruction_pointer, int *instruction_count, int mic) {
+    int start = tm->regions[index].start;
+    int end = tm->regions[index].end;
+    DecodedInstruction *code = tm->regions[index].code;
+    int ip = *instruction_pointer;
+    int count = *instruction_count;
+    int halted = 0;
+
+    tm->regions[index].entries++;
+
+    while (ip >= start && ip <= end) {
+        if (count >= mic) {
+            printf("Error: Maximum instruction count exceeded, possible infinite loop\n");
+            exit(1);
+        }
+
+        DecodedInstruction *d = &code[ip - start];
+        // Must stay in lockstep with the switch in execute_program: jumps other than JE and JNE
+        // skip the increment, so a not-taken JZ, JNZ, BZ or BNZ re-executes without counting
+        switch (d->opcode) {
+            case ADD:
+                *d->dst = *d->src1 + *d->src2;
+                break;
+            case SUB:
+                *d->dst = *d->src1 - *d->src2;
+                break;
+            case MUL:
+                *d->dst = *d->src1 * *d->src2;
+                break;
+            case DIV:
+                if (*d->src2 == 0) {
+                    printf("Error: Division by zero on R%d of value %d\n", d->reg2, *d->src2);
+                    exit(1);
+                }
+                *d->dst = *d->src1 / *d->src2;
+                break;
+            case STORE:
+            case LOAD:
+            case MOV:
+                *d->dst = *d->src1;
+                break;
+            case LOAD_IMMEDIATE:
+                *d->dst = d->immediate;
+                break;
+            case PUSH:
+                push(pu, d->reg1);
+                break;
+            case POP:
+                pop(pu, d->reg1);
+                break;
+            case JMP:
+            case B:
+                ip = d->addr;
+                d->back_edges += d->back_edge;
+                continue;
+            case JZ:
+            case BZ:
+                if (*d->src1 == 0) {
+                    ip = d->addr;
+                    d->back_edges += d->back_edge;
+                }
+                continue;
+            case JNZ:
+            case BNZ:
+                if (*d->src1 != 0) {
+                    ip = d->addr;
+                    d->back_edges += d->back_edge;
+                }
+                continue;
+            case JE:
+                if (*d->src1 == *d->src2) {
+                    ip = d->addr;
+                    d->back_edges += d->back_edge;
+                }
+                break;
+            case JNE:
+                if (*d->src1 != *d->src2) {
+                    ip = d->addr;
+                    d->back_edges += d->back_edge;
+                }
+                break;
+            case AND:
+                *d->dst = *d->src1 & *d->src2;
+                break;
+            case OR:
+                *d->dst = *d->src1 | *d->src2;
+                break;
+            case XOR:
+                *d->dst = *d->src1 ^ *d->src2;
+                break;
+            case NOT:
+                *d->dst = ~*d->src1;
+                break;
+            case SHL:
+                *d->dst = *d->src1 << *d->src2;
+                break;
+            case SHR:
+                *d->dst = *d->src1 >> *d->src2;
+                break;
+            case CMP:
+                if (*d->src1 == *d->src2) {
+                    *d->dst = 0;
+                } else if (*d->src1 < *d->src2) {
+                    *d->dst = -1;
+                } else {
+                    *d->dst = 1;
+                }
+                break;
+            case TEST:
+                *d->dst = *d->src1 & *d->src2;
+                break;
+            case NEG:
+                *d->dst = -*d->src1;
+                break;
+            case ABS:
+                *d->dst = abs(*d->src1);
+                break;
+            case MOD:
+                if (*d->src2 == 0) {
+                    printf("Error: Division by zero on R%d of value %d\n", d->reg2, *d->src2);
+                    exit(1);
+                }
+                *d->dst = *d->src1 % *d->src2;
+                break;
+            case INC:
+                (*d->dst)++;
+                break;
+            case DEC:
+                (*d->dst)--;
+                break;
+            case HALT:
+                halted = 1;
+                break;
+            default:
+                printf("Error: Unknown opcode %d\n", d->opcode);
+                exit(1);
+        }
+        if (halted) {
+            break;
+        }
+        ip++;
+        count++;
+    }
+
+    // Hand the back-edges taken inside the region to their loops, which may promote nested loops
+    for (int i = 0; i <= end - start; i++) {
+        if (code[i].back_edges > 0) {
+            int taken = code[i].back_edges;
+            code[i].back_edges = 0;
+            record_back_edges(tm, pu, program, start + i, taken);
+        }
+    }
+
+    // Transfer the instruction pointer back to the interpreter
+    tm->regions[index].instruction_count += count - *instruction_count;
+    *instruction_pointer = ip;
+    *instruction_count = count;
+    return halted;
+}
+
+// Function to print the tier decision for each loop region
+void print_tier_report(TieringManager *tm) {
+    if (tm->threshold <= 0) {
+        printf("Tiers:\nTiering disabled\n");
+        return;
+    }
+
+    if (tm->num_regions == 0) {
+        return;
+    }
+
+    printf("Tiers:\n");
+    for (int i = 0; i < tm->num_regions; i++) {
+        Region *region = &tm->regions[i];
+        printf("L%d: %d-%d back-edges=%d ", i, region->start, region->end, region->back_edges);
+        if (region->tier == TIER_PREDECODED) {
+            printf("tier=predecoded entries=%d instructions=%d\n", region->entries, region->instruction_count);
+        } else if (region->owner != -1) {
+            printf("tier=interpreter (header owned by L%d)\n", region->owner);
+        } else if (region->reason != NULL) {
+            printf("tier=interpreter (%s)\n", region->reason);
+        } else {
+            printf("tier=interpreter (below threshold %d)\n", tm->threshold);
+        }
+    }
+}
+
 // ++++++++++++++++++++++++++++++ Program execution ++++++++++++++++++++++++++++++ //
-void execute_program(ProcessingUnit *pu, Instruction *program, int program_size, int mic) {
+// Every program starts in the interpreter, hot loops are handed to the tiering manager
+void execute_program(ProcessingUnit *pu, TieringManager *tm, Instruction *program, int program_size, int mic) {
     const int MAX_INSTRUCTION_COUNT = mic;
     int instruction_count = 0;
     int instruction_pointer = 0;
+    const int tiering = tm->threshold > 0; // With tiering disabled, jumps are not profiled at all
+    int check_entry = 0; // Set after a back-edge, the only way to reach a promoted loop header
 
     while (instruction_pointer < program_size) {
         if (instruction_count >= MAX_INSTRUCTION_COUNT) {
@@ -359,7 +808,22 @@ void execute_program(ProcessingUnit *pu, Instruction *program, int program_size,
             exit(1);
         }
 
+        if (check_entry) {
+            check_entry = 0;
+            int index = instruction_pointer >= 0 ? tm->region_at_entry[instruction_pointer] : -1;
+            if (index != -1) {
+                if (execute_region(tm, index, pu, program, &instruction_pointer, &instruction_count, MAX_INSTRUCTION_COUNT)) {
+                    return;
+                }
+                // The region may have left through a back-edge onto another loop header
+                check_entry = 1;
+                continue;
+            }
+        }
+
+        int source = instruction_pointer;
         Instruction instr = program[instruction_pointer];
+        // Control flow here must stay in lockstep with the switch in execute_region
         switch (instr.opcode) {
             case ADD:
                 add(pu, instr.reg1, instr.reg2, instr.reg3);
@@ -391,21 +855,36 @@ void execute_program(ProcessingUnit *pu, Instruction *program, int program_size,
                 break;
             case JMP:
                 jmp(&instruction_pointer, instr.addr);
+                if (tiering && instruction_pointer <= source) {
+                    check_entry = profile_branch(tm, pu, program, source, instruction_pointer);
+                }
                 continue;
             case JZ:
                 jz(pu, &instruction_pointer, instr.reg1, instr.addr);
+                if (tiering && instruction_pointer <= source) {
+                    check_entry = profile_branch(tm, pu, program, source, instruction_pointer);
+                }
                 continue;
             case JNZ:
                 jnz(pu, &instruction_pointer, instr.reg1, instr.addr);
+                if (tiering && instruction_pointer <= source) {
+                    check_entry = profile_branch(tm, pu, program, source, instruction_pointer);
+                }
                 continue;
             case MOV:
                 mov(pu, instr.reg1, instr.reg2);
                 break;
             case JE:
                 je(pu, &instruction_pointer, instr.reg1, instr.reg2, instr.addr);
+                if (tiering && instruction_pointer <= source) {
+                    check_entry = profile_branch(tm, pu, program, source, instruction_pointer);
+                }
                 break;
             case JNE:
                 jne(pu, &instruction_pointer, instr.reg1, instr.reg2, instr.addr);
+                if (tiering && instruction_pointer <= source) {
+                    check_entry = profile_branch(tm, pu, program, source, instruction_pointer);
+                }
                 break;
             case AND:
                 and(pu, instr.reg1, instr.reg2, instr.reg3);
@@ -433,12 +912,21 @@ void execute_program(ProcessingUnit *pu, Instruction *program, int program_size,
                 break;
             case B:
                 b(&instruction_pointer, instr.addr);
+                if (tiering && instruction_pointer <= source) {
+                    check_entry = profile_branch(tm, pu, program, source, instruction_pointer);
+                }
                 continue;
             case BZ:
                 bz(pu, &instruction_pointer, instr.reg1, instr.addr);
+                if (tiering && instruction_pointer <= source) {
+                    check_entry = profile_branch(tm, pu, program, source, instruction_pointer);
+                }
                 continue;
             case BNZ:
                 bnz(pu, &instruction_pointer, instr.reg1, instr.addr);
+                if (tiering && instruction_pointer <= source) {
+                    check_entry = profile_branch(tm, pu, program, source, instruction_pointer);
+                }
                 continue;
             case NEG:
                 neg(pu, instr.reg1, instr.reg2);
@@ -477,8 +965,8 @@ void free_processing_unit_state(ProcessingUnitState *state) {
 }
 
 // Function to run the program and return the state
-ProcessingUnitState run(ProcessingUnit *pu, Instruction *program, int program_size, int mic) {
-    execute_program(pu, program, program_size, mic);
+ProcessingUnitState run(ProcessingUnit *pu, TieringManager *tm, Instruction *program, int program_size, int mic) {
+    execute_program(pu, tm, program, program_size, mic);
 
     ProcessingUnitState state;
     state.stack_size = pu->memory_size - pu->stack_pointer - 1;
@@ -639,8 +1127,8 @@ Instruction* parse_instruction_file(const char* filename, int* program_size) {
 
 // Modify the main function to use the new parser
 int main(int argc, char *argv[]) {
-    if (argc != 4) {
-        printf("Usage: %s <register_size_dimensions> <memory_size_dimensions> <instruction_file>\n", argv[0]);
+    if (argc != 4 && argc != 5) {
+        printf("Usage: %s <register_size_dimensions> <memory_size_dimensions> <instruction_file> [tier_threshold]\n", argv[0]);
         exit(1);
     }
 
@@ -655,11 +1143,25 @@ int main(int argc, char *argv[]) {
     int program_size;
     Instruction* program = parse_instruction_file(argv[3], &program_size);
 
+    // Loops are promoted after this many back-edges, 0 keeps everything in the interpreter
+    // Passing the threshold also requests the tier report
+    int tier_threshold = 50;
+    if (argc == 5) {
+        tier_threshold = atoi(argv[4]);
+    }
+
+    TieringManager tm;
+    initialize_tiering(&tm, program_size, tier_threshold);
+
     // Run the program
-    ProcessingUnitState state = run(&pu, program, program_size, 1000);
+    ProcessingUnitState state = run(&pu, &tm, program, program_size, 1000);
 
     // Clean up
     post_run(&state, &pu, program);
+    if (argc == 5) {
+        print_tier_report(&tm);
+    }
+    free_tiering_manager(&tm);
 
     exit(0);
 }